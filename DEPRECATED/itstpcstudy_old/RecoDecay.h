@@ -18,8 +18,14 @@
 
 #include <tuple>
 #include <vector>
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
 
 #include <TDatabasePDG.h>
 #include <TPDGCode.h>
@@ -41,6 +47,21 @@ class RecoDecay
   /// Default destructor
   ~RecoDecay() = default;
 
+  // Precision policy
+  //
+  // Calculations are done in float if all inputs are float and in double
+  // otherwise (double, integer or mixed inputs), and return that type, so
+  // that float pipelines (AO2D columns) never round-trip through double.
+  // Pass double inputs (e.g. double masses) to get double precision.
+
+  /// Floating-point type of a calculation with inputs of types T...
+  template <typename... T>
+  using Precision = std::conditional_t<(std::is_same_v<std::decay_t<T>, float> && ...), float, double>;
+
+  /// Floating-point type of a calculation with inputs of the element types of containers T...
+  template <typename... T>
+  using PrecisionOf = Precision<std::decay_t<decltype(std::declval<const T&>()[0])>...>;
+
   // Auxiliary functions
 
   /// Sums numbers.
@@ -53,30 +74,30 @@ class RecoDecay
   }
 
   /// Squares a number.
-  /// \note Promotes number to double before squaring to avoid precision loss in float multiplication.
+  /// \note Computed in float for float input, in double otherwise.
   /// \param num  a number of arbitrary type
   /// \return number squared
   template <typename T>
-  static double sq(T num)
+  static Precision<T> sq(T num)
   {
-    return (double)num * (double)num;
+    return (Precision<T>)num * (Precision<T>)num;
   }
 
   /// Sums squares of numbers.
-  /// \note Promotes numbers to double before squaring to avoid precision loss in float multiplication.
+  /// \note Computed in float if all numbers are float, in double otherwise.
   /// \param args  arbitrary number of numbers of arbitrary types
   /// \return sum of squares of numbers
   template <typename... T>
-  static double sumOfSquares(const T&... args)
+  static Precision<T...> sumOfSquares(const T&... args)
   {
-    return (((double)args * (double)args) + ...);
+    return (((Precision<T...>)args * (Precision<T...>)args) + ...);
   }
 
   /// Calculates square root of a sum of squares of numbers.
   /// \param args  arbitrary number of numbers of arbitrary types
   /// \return square root of sum of squares of numbers
   template <typename... T>
-  static double sqrtSumOfSquares(const T&... args)
+  static Precision<T...> sqrtSumOfSquares(const T&... args)
   {
     return std::sqrt(sumOfSquares(args...));
   }
@@ -101,16 +122,16 @@ class RecoDecay
   }
 
   /// Calculates scalar product of vectors.
-  /// \note Promotes numbers to double before squaring to avoid precision loss in float multiplication.
+  /// \note Computed in float if both vectors are float, in double otherwise.
   /// \param N  dimension
   /// \param vec1,vec2  vectors
   /// \return scalar product
   template <std::size_t N, typename T, typename U>
-  static double dotProd(const array<T, N>& vec1, const array<U, N>& vec2)
+  static Precision<T, U> dotProd(const array<T, N>& vec1, const array<U, N>& vec2)
   {
-    double res{0};
+    Precision<T, U> res{0};
     for (auto iDim = 0; iDim < N; ++iDim) {
-      res += (double)vec1[iDim] * (double)vec2[iDim];
+      res += (Precision<T, U>)vec1[iDim] * (Precision<T, U>)vec2[iDim];
     }
     return res;
   }
@@ -120,7 +141,7 @@ class RecoDecay
   /// \param vec  vector
   /// \return magnitude squared
   template <std::size_t N, typename T>
-  static double mag2(const array<T, N>& vec)
+  static Precision<T> mag2(const array<T, N>& vec)
   {
     return dotProd(vec, vec);
   }
@@ -129,7 +150,7 @@ class RecoDecay
   /// \param point1,point2  {x, y, z} coordinates of points
   /// \return 3D distance between two points
   template <typename T, typename U>
-  static double distance(const T& point1, const U& point2)
+  static PrecisionOf<T, U> distance(const T& point1, const U& point2)
   {
     return sqrtSumOfSquares(point1[0] - point2[0], point1[1] - point2[1], point1[2] - point2[2]);
   }
@@ -138,7 +159,7 @@ class RecoDecay
   /// \param point1,point2  {x, y, z} or {x, y} coordinates of points
   /// \return 2D {x, y} distance between two points
   template <typename T, typename U>
-  static double distanceXY(const T& point1, const U& point2)
+  static PrecisionOf<T, U> distanceXY(const T& point1, const U& point2)
   {
     return sqrtSumOfSquares(point1[0] - point2[0], point1[1] - point2[1]);
   }
@@ -149,13 +170,13 @@ class RecoDecay
   /// \param mom  3-momentum array
   /// \return pseudorapidity
   template <typename T>
-  static double Eta(const array<T, 3>& mom)
+  static Precision<T> Eta(const array<T, 3>& mom)
   {
     // eta = arctanh(pz/p)
     if (std::abs(mom[0]) < Almost0 && std::abs(mom[1]) < Almost0) { // very small px and py
-      return (double)(mom[2] > 0 ? VeryBig : -VeryBig);
+      return (Precision<T>)(mom[2] > 0 ? VeryBig : -VeryBig);
     }
-    return (double)(std::atanh(mom[2] / P(mom)));
+    return (Precision<T>)(std::atanh(mom[2] / P(mom)));
   }
 
   /// Calculates rapidity.
@@ -163,7 +184,7 @@ class RecoDecay
   /// \param mass  mass
   /// \return rapidity
   template <typename T, typename U>
-  static double Y(const array<T, 3>& mom, U mass)
+  static Precision<T, U> Y(const array<T, 3>& mom, U mass)
   {
     // y = arctanh(pz/E)
     return std::atanh(mom[2] / E(mom, mass));
@@ -193,16 +214,16 @@ class RecoDecay
   /// \param mom  3-momentum array
   /// \return cosine of pointing angle
   template <typename T, typename U, typename V>
-  static double CPA(const T& posPV, const U& posSV, const array<V, 3>& mom)
+  static PrecisionOf<T, U, array<V, 3>> CPA(const T& posPV, const U& posSV, const array<V, 3>& mom)
   {
     // CPA = (l . p)/(|l| |p|)
     auto lineDecay = array{posSV[0] - posPV[0], posSV[1] - posPV[1], posSV[2] - posPV[2]};
-    auto cos = dotProd(lineDecay, mom) / std::sqrt(mag2(lineDecay) * mag2(mom));
-    if (cos < -1.) {
-      return -1.;
+    PrecisionOf<T, U, array<V, 3>> cos = dotProd(lineDecay, mom) / std::sqrt(mag2(lineDecay) * mag2(mom));
+    if (cos < -1) {
+      return -1;
     }
-    if (cos > 1.) {
-      return 1.;
+    if (cos > 1) {
+      return 1;
     }
     return cos;
   }
@@ -213,44 +234,48 @@ class RecoDecay
   /// \param mom  {x, y, z} or {x, y} momentum array
   /// \return cosine of pointing angle in {x, y}
   template <std::size_t N, typename T, typename U, typename V>
-  static double CPAXY(const T& posPV, const U& posSV, const array<V, N>& mom)
+  static PrecisionOf<T, U, array<V, N>> CPAXY(const T& posPV, const U& posSV, const array<V, N>& mom)
   {
     // CPAXY = (r . pT)/(|r| |pT|)
     auto lineDecay = array{posSV[0] - posPV[0], posSV[1] - posPV[1]};
     auto momXY = array{mom[0], mom[1]};
-    auto cos = dotProd(lineDecay, momXY) / std::sqrt(mag2(lineDecay) * mag2(momXY));
-    if (cos < -1.) {
-      return -1.;
+    PrecisionOf<T, U, array<V, N>> cos = dotProd(lineDecay, momXY) / std::sqrt(mag2(lineDecay) * mag2(momXY));
+    if (cos < -1) {
+      return -1;
     }
-    if (cos > 1.) {
-      return 1.;
+    if (cos > 1) {
+      return 1;
     }
     return cos;
   }
 
   /// Calculates proper lifetime times c.
-  /// \note Promotes numbers to double before squaring to avoid precision loss in float multiplication.
+  /// \note Computed in float if all inputs are float, in double otherwise.
   /// \param mom  3-momentum array
   /// \param mass  mass
   /// \param length  decay length
   /// \return proper lifetime times c
   template <typename T, typename U, typename V>
-  static double Ct(const array<T, 3>& mom, U length, V mass)
+  static Precision<T, U, V> Ct(const array<T, 3>& mom, U length, V mass)
   {
     // c t = l m c^2/(p c)
-    return (double)length * (double)mass / P(mom);
+    return (Precision<T, U, V>)length * (Precision<T, U, V>)mass / P(mom);
   }
 
   /// Calculates cosine of θ* (theta star).
-  /// \note Implemented for 2 prongs only.
+  /// \note Implemented for 2 prongs only. Always computed in double: p* is a small
+  /// difference of large numbers for prongs close to threshold.
   /// \param arrMom  array of two 3-momentum arrays
   /// \param arrMass  array of two masses (in the same order as arrMom)
   /// \param mTot  assumed mass of mother particle
   /// \param iProng  index of the prong
   /// \return cosine of θ* of the i-th prong under the assumption of the invariant mass
   template <typename T, typename U, typename V>
-  static double CosThetaStar(const array<array<T, 3>, 2>& arrMom, const array<U, 2>& arrMass, V mTot, int iProng)
+  static double CosThetaStar(const array<array<T, 3>, 2>& arrMomIn, const array<U, 2>& arrMassIn, V mTotIn, int iProng)
   {
+    array<array<double, 3>, 2> arrMom{{{(double)arrMomIn[0][0], (double)arrMomIn[0][1], (double)arrMomIn[0][2]}, {(double)arrMomIn[1][0], (double)arrMomIn[1][1], (double)arrMomIn[1][2]}}};
+    array<double, 2> arrMass{(double)arrMassIn[0], (double)arrMassIn[1]};
+    double mTot = mTotIn;
     auto pVecTot = PVec(arrMom[0], arrMom[1]);                                                                             // momentum of the mother particle
     auto pTot = P(pVecTot);                                                                                                // magnitude of the momentum of the mother particle
     auto eTot = E(pTot, mTot);                                                                                             // energy of the mother particle
@@ -286,7 +311,7 @@ class RecoDecay
   /// \param args  pack of 3-momentum arrays
   /// \return total momentum squared
   template <typename... T>
-  static double P2(const array<T, 3>&... args)
+  static Precision<T...> P2(const array<T, 3>&... args)
   {
     return sumOfSquares(getElement(0, args...), getElement(1, args...), getElement(2, args...));
   }
@@ -295,7 +320,7 @@ class RecoDecay
   /// \param args  {x, y, z} momentum components or pack of 3-momentum arrays
   /// \return (total) momentum magnitude
   template <typename... T>
-  static double P(const T&... args)
+  static auto P(const T&... args)
   {
     return std::sqrt(P2(args...));
   }
@@ -312,7 +337,7 @@ class RecoDecay
   /// \param args  pack of 3-(or 2-)momentum arrays
   /// \return total transverse momentum squared
   template <std::size_t N, typename... T>
-  static double Pt2(const array<T, N>&... args)
+  static Precision<T...> Pt2(const array<T, N>&... args)
   {
     return sumOfSquares(getElement(0, args...), getElement(1, args...));
   }
@@ -321,7 +346,7 @@ class RecoDecay
   /// \param args  {x, y} momentum components or pack of 3-momentum arrays
   /// \return (total) transverse momentum
   template <typename... T>
-  static double Pt(const T&... args)
+  static auto Pt(const T&... args)
   {
     return std::sqrt(Pt2(args...));
   }
@@ -331,7 +356,7 @@ class RecoDecay
   /// \param args  {x, y, z} momentum components, mass
   /// \return energy squared
   template <typename... T>
-  static double E2(T... args)
+  static Precision<T...> E2(T... args)
   {
     return sumOfSquares(args...);
   }
@@ -341,7 +366,7 @@ class RecoDecay
   /// \param mass  mass
   /// \return energy squared
   template <typename T, typename U>
-  static double E2(const array<T, 3>& mom, U mass)
+  static Precision<T, U> E2(const array<T, 3>& mom, U mass)
   {
     return E2(mom[0], mom[1], mom[2], mass);
   }
@@ -352,7 +377,7 @@ class RecoDecay
   /// \param args  3-momentum array, mass
   /// \return energy
   template <typename... T>
-  static double E(const T&... args)
+  static auto E(const T&... args)
   {
     return std::sqrt(E2(args...));
   }
@@ -382,10 +407,10 @@ class RecoDecay
   /// \param arrMass  array of N masses (in the same order as arrMom)
   /// \return invariant mass squared
   template <std::size_t N, typename T, typename U>
-  static double M2(const array<array<T, 3>, N>& arrMom, const array<U, N>& arrMass)
+  static Precision<T, U> M2(const array<array<T, 3>, N>& arrMom, const array<U, N>& arrMass)
   {
-    array<double, 3> momTotal{0., 0., 0.}; // candidate momentum vector
-    double energyTot{0.};                  // candidate energy
+    array<Precision<T, U>, 3> momTotal{0, 0, 0}; // candidate momentum vector
+    Precision<T, U> energyTot{0};                // candidate energy
     for (auto iProng = 0; iProng < N; ++iProng) {
       for (auto iMom = 0; iMom < 3; ++iMom) {
         momTotal[iMom] += arrMom[iProng][iMom];
@@ -401,26 +426,247 @@ class RecoDecay
   /// \param args  array of momenta, array of masses
   /// \return invariant mass
   template <typename... T>
-  static double M(const T&... args)
+  static auto M(const T&... args)
   {
     return std::sqrt(M2(args...));
   }
 
+  // Batch kernels over candidate arrays
+  //
+  // The *Batch functions process n candidates stored as structure of arrays,
+  // one output element per candidate. The loops have no branches and no
+  // cross-iteration dependencies, so the compiler vectorises them (-O3, or
+  // -O2 -ftree-vectorize, plus -fno-math-errno for the square roots);
+  // otherwise they run as plain scalar loops. Same precision policy as the
+  // per-candidate functions above, and the results agree with them.
+
+  /// Structure-of-arrays view of n 3-vectors (momenta or positions).
+  template <typename T>
+  struct SpanVec3 {
+    const T* x; ///< x components
+    const T* y; ///< y components
+    const T* z; ///< z components
+  };
+
+  /// Calculates invariant masses squared of n candidates.
+  /// \param n  number of candidates
+  /// \param arrMom  array of N prong 3-momentum spans
+  /// \param arrMass  array of N masses (in the same order as arrMom)
+  /// \param out  output array of n invariant masses squared
+  template <std::size_t N, typename T, typename U, typename R>
+  static void M2Batch(std::size_t n, const array<SpanVec3<T>, N>& arrMom, const array<U, N>& arrMass, R* __restrict__ out)
+  {
+    using F = Precision<T, U>;
+    array<F, N> arrMass2;
+    for (std::size_t iProng = 0; iProng < N; ++iProng) {
+      arrMass2[iProng] = sq(arrMass[iProng]);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      F px{0}, py{0}, pz{0}, energyTot{0};
+      for (std::size_t iProng = 0; iProng < N; ++iProng) { // unrolled, N is known at compile time
+        F pxI = arrMom[iProng].x[i], pyI = arrMom[iProng].y[i], pzI = arrMom[iProng].z[i];
+        px += pxI;
+        py += pyI;
+        pz += pzI;
+        energyTot += std::sqrt(pxI * pxI + pyI * pyI + pzI * pzI + arrMass2[iProng]);
+      }
+      out[i] = energyTot * energyTot - (px * px + py * py + pz * pz);
+    }
+  }
+
+  /// Calculates invariant masses of n candidates.
+  /// \param n  number of candidates
+  /// \param arrMom  array of N prong 3-momentum spans
+  /// \param arrMass  array of N masses (in the same order as arrMom)
+  /// \param out  output array of n invariant masses
+  template <std::size_t N, typename T, typename U, typename R>
+  static void MBatch(std::size_t n, const array<SpanVec3<T>, N>& arrMom, const array<U, N>& arrMass, R* __restrict__ out)
+  {
+    M2Batch(n, arrMom, arrMass, out);
+    for (std::size_t i = 0; i < n; ++i) {
+      out[i] = std::sqrt((Precision<T, U>)out[i]);
+    }
+  }
+
+  /// Calculates cosines of pointing angle of n candidates.
+  /// \param n  number of candidates
+  /// \param posPV  positions of the primary vertices
+  /// \param posSV  positions of the secondary vertices
+  /// \param mom  candidate 3-momenta
+  /// \param out  output array of n cosines of pointing angle
+  template <typename T, typename U, typename V, typename R>
+  static void CPABatch(std::size_t n, const SpanVec3<T>& posPV, const SpanVec3<U>& posSV, const SpanVec3<V>& mom, R* __restrict__ out)
+  {
+    using F = Precision<T, U, V>;
+    for (std::size_t i = 0; i < n; ++i) {
+      F lx = posSV.x[i] - posPV.x[i], ly = posSV.y[i] - posPV.y[i], lz = posSV.z[i] - posPV.z[i];
+      F px = mom.x[i], py = mom.y[i], pz = mom.z[i];
+      F cos = (lx * px + ly * py + lz * pz) / std::sqrt((lx * lx + ly * ly + lz * lz) * (px * px + py * py + pz * pz));
+      out[i] = std::min(std::max(cos, F(-1)), F(1));
+    }
+  }
+
+  /// Calculates cosines of pointing angle in the {x, y} plane of n candidates.
+  /// \param n  number of candidates
+  /// \param posPV  positions of the primary vertices (z ignored)
+  /// \param posSV  positions of the secondary vertices (z ignored)
+  /// \param mom  candidate momenta (z ignored)
+  /// \param out  output array of n cosines of pointing angle in {x, y}
+  template <typename T, typename U, typename V, typename R>
+  static void CPAXYBatch(std::size_t n, const SpanVec3<T>& posPV, const SpanVec3<U>& posSV, const SpanVec3<V>& mom, R* __restrict__ out)
+  {
+    using F = Precision<T, U, V>;
+    for (std::size_t i = 0; i < n; ++i) {
+      F lx = posSV.x[i] - posPV.x[i], ly = posSV.y[i] - posPV.y[i];
+      F px = mom.x[i], py = mom.y[i];
+      F cos = (lx * px + ly * py) / std::sqrt((lx * lx + ly * ly) * (px * px + py * py));
+      out[i] = std::min(std::max(cos, F(-1)), F(1));
+    }
+  }
+
+  /// Calculates proper lifetimes times c of n candidates under one mass hypothesis.
+  /// \param n  number of candidates
+  /// \param mom  candidate 3-momenta
+  /// \param length  decay lengths
+  /// \param mass  mass
+  /// \param out  output array of n proper lifetimes times c
+  template <typename T, typename U, typename V, typename R>
+  static void CtBatch(std::size_t n, const SpanVec3<T>& mom, const U* length, V mass, R* __restrict__ out)
+  {
+    using F = Precision<T, U, V>;
+    for (std::size_t i = 0; i < n; ++i) {
+      F px = mom.x[i], py = mom.y[i], pz = mom.z[i];
+      out[i] = (F)length[i] * (F)mass / std::sqrt(px * px + py * py + pz * pz);
+    }
+  }
+
+  /// Looks up a particle mass in the compile-time table.
+  /// \param pdg  PDG code (antiparticles share the mass of the particle)
+  /// \return particle mass, or -1 if the PDG code is not in the table
+  static constexpr double findMassPDG(int pdg)
+  {
+    int absPDG = pdg < 0 ? -pdg : pdg;
+    std::size_t lo = 0, hi = MassTable.size();
+    while (lo < hi) { // binary search, the table is sorted by PDG code
+      std::size_t mid = (lo + hi) / 2;
+      if (MassTable[mid].first < absPDG) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return (lo < MassTable.size() && MassTable[lo].first == absPDG) ? MassTable[lo].second : -1.;
+  }
+
+  /// Returns particle mass based on a PDG code known at compile time.
+  /// \param pdg  PDG code, must be in the compile-time table
+  /// \return particle mass
+  template <int pdg>
+  static constexpr double getMassPDG()
+  {
+    constexpr double mass = findMassPDG(pdg);
+    static_assert(mass >= 0., "PDG code not in RecoDecay::MassTable, use getMassPDG(pdg)");
+    return mass;
+  }
+
   /// Returns particle mass based on PDG code.
+  /// \note Thread-safe. The mass is taken from TDatabasePDG once, as before, and then
+  /// served from a lock-free cache. The compile-time table is not used here, its values
+  /// (see MassTable) may differ slightly from those of TDatabasePDG.
   /// \param pdg  PDG code
   /// \return particle mass
   static double getMassPDG(int pdg)
   {
-    // Try to get the particle mass from the list first.
-    for (const auto& particle : mListMass) {
-      if (std::get<0>(particle) == pdg) {
-        return std::get<1>(particle);
+    double mass;
+    if (mListMass.find(pdg, mass)) {
+      return mass;
+    }
+    // Get the mass of the new particle and add it in the cache.
+    {
+      // TDatabasePDG is not thread-safe, only the (rare) misses are serialised
+      std::lock_guard<std::mutex> lock(mMutexPDG);
+      auto particle = TDatabasePDG::Instance()->GetParticle(pdg);
+      if (!particle) {
+        LOGF(error, "RecoDecay::getMassPDG: unknown PDG code %d", pdg);
+        return -1.;
       }
+      mass = particle->Mass();
+    }
+    mListMass.insert(pdg, mass);
+    return mass;
+  }
+
+  // cos θ* for a fixed mass hypothesis
+  //
+  // For a fixed (mother, prong, prong) hypothesis such as K0S -> π+ π-, p* and
+  // the prong energies in the rest frame are constants. They are folded at
+  // compile time in TwoProngHypothesis and the remaining per-candidate work is
+  // one square root and one division.
+
+  /// Square root usable in constant expressions (Newton iteration).
+  static constexpr double constexprSqrt(double x)
+  {
+    if (x <= 0.) {
+      return 0.;
+    }
+    double root = x > 1. ? x : 1.;
+    for (auto iIter = 0; iIter < 100; ++iIter) {
+      double next = 0.5 * (root + x / root);
+      if (next >= root) {
+        break;
+      }
+      root = next;
+    }
+    return root;
+  }
+
+  /// Rest-frame constants of a two-prong decay hypothesis, masses from the compile-time table.
+  /// \note The mother must be massive: cos θ* is not defined for e.g. a photon hypothesis.
+  template <int PDGMother, int PDGProng0, int PDGProng1>
+  struct TwoProngHypothesis {
+    static constexpr double mTot = getMassPDG<PDGMother>();
+    static constexpr array<double, 2> arrMass{getMassPDG<PDGProng0>(), getMassPDG<PDGProng1>()};
+    static_assert(mTot > arrMass[0] + arrMass[1], "cos(theta*) needs a mother mass above the two-prong threshold");
+    // p* = √[(M^2 - m1^2 - m2^2)^2 - 4 m1^2 m2^2]/2M
+    static constexpr double pStar = constexprSqrt((mTot * mTot - arrMass[0] * arrMass[0] - arrMass[1] * arrMass[1]) * (mTot * mTot - arrMass[0] * arrMass[0] - arrMass[1] * arrMass[1]) - 4. * arrMass[0] * arrMass[0] * arrMass[1] * arrMass[1]) / (2. * mTot);
+    static constexpr double invPStar = 1. / pStar;
+    static constexpr array<double, 2> arrEStar{constexprSqrt(pStar * pStar + arrMass[0] * arrMass[0]), constexprSqrt(pStar * pStar + arrMass[1] * arrMass[1])}; // E*_i
+  };
+
+  /// Calculates cosine of θ* (theta star) under a fixed mass hypothesis.
+  /// \note Same result as CosThetaStar(arrMom, Hypothesis::arrMass, Hypothesis::mTot, iProng), computed in double.
+  /// \param Hypothesis  a TwoProngHypothesis, e.g. TwoProngHypothesis<kK0Short, kPiPlus, kPiPlus>
+  /// \param arrMom  array of two 3-momentum arrays (in the order of the hypothesis prongs)
+  /// \param iProng  index of the prong
+  /// \return cosine of θ* of the i-th prong
+  template <typename Hypothesis, typename T>
+  static double CosThetaStar(const array<array<T, 3>, 2>& arrMom, int iProng)
+  {
+    double px = (double)arrMom[0][0] + arrMom[1][0], py = (double)arrMom[0][1] + arrMom[1][1], pz = (double)arrMom[0][2] + arrMom[1][2];
+    double pTot2 = px * px + py * py + pz * pz;
+    double dot = px * arrMom[iProng][0] + py * arrMom[iProng][1] + pz * arrMom[iProng][2];
+    // cos(θ*_i) = (p_L,i/γ - β E*_i)/p* = (p_i . p M - p^2 E*_i)/(p E p*)
+    return (dot * Hypothesis::mTot - pTot2 * Hypothesis::arrEStar[iProng]) * Hypothesis::invPStar / std::sqrt(pTot2 * (pTot2 + Hypothesis::mTot * Hypothesis::mTot));
+  }
+
+  /// Calculates cosines of θ* (theta star) of n candidates under a fixed mass hypothesis.
+  /// \param Hypothesis  a TwoProngHypothesis
+  /// \param n  number of candidates
+  /// \param arrMom  array of two prong 3-momentum spans
+  /// \param iProng  index of the prong
+  /// \param out  output array of n cosines of θ*
+  template <typename Hypothesis, typename T, typename R>
+  static void CosThetaStarBatch(std::size_t n, const array<SpanVec3<T>, 2>& arrMom, int iProng, R* __restrict__ out)
+  {
+    constexpr double mTot = Hypothesis::mTot, mTot2 = mTot * mTot, invPStar = Hypothesis::invPStar;
+    const double eStar = Hypothesis::arrEStar[iProng];
+    const auto& momI = arrMom[iProng];
+    for (std::size_t i = 0; i < n; ++i) {
+      double px = (double)arrMom[0].x[i] + arrMom[1].x[i], py = (double)arrMom[0].y[i] + arrMom[1].y[i], pz = (double)arrMom[0].z[i] + arrMom[1].z[i];
+      double pTot2 = px * px + py * py + pz * pz;
+      double dot = px * momI.x[i] + py * momI.y[i] + pz * momI.z[i];
+      out[i] = (dot * mTot - pTot2 * eStar) * invPStar / std::sqrt(pTot2 * (pTot2 + mTot2));
     }
-    // Get the mass of the new particle and add it in the list.
-    auto newMass = TDatabasePDG::Instance()->GetParticle(pdg)->Mass();
-    mListMass.push_back(std::make_tuple(pdg, newMass));
-    return newMass;
   }
 
   /// Check whether the reconstructed decay candidate is the expected decay.
@@ -593,10 +839,297 @@ class RecoDecay
     return true;
   }
 
+  // Bulk MC matching
+  //
+  // isMCMatchedDecayRec/Gen walk the MC table for every candidate. For bulk
+  // matching, MCDecayIndex flattens the table once per dataframe (mother,
+  // daughter range, PDG code and a decay signature per particle), after which
+  // every candidate is answered with a few array lookups. A matching hash is
+  // confirmed against the daughter PDG codes, so hash collisions are not accepted.
+
+  /// Mixes 64 bits (splitmix64 finaliser).
+  static constexpr uint64_t mixBits(uint64_t x)
+  {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  /// Calculates the hash of a decay, independent of the order of the daughters.
+  /// \param PDGMother  PDG code of the mother
+  /// \param PDGDaughters  PDG codes of the daughters
+  /// \param nDaughters  number of daughters
+  /// \param sgn  -1 to hash the charge-conjugate decay
+  static constexpr uint64_t decayHash(int PDGMother, const int* PDGDaughters, int nDaughters, int sgn = 1)
+  {
+    uint64_t sumDaughters = mixBits(nDaughters);
+    for (auto iProng = 0; iProng < nDaughters; ++iProng) {
+      sumDaughters += mixBits((uint64_t)(int64_t)(sgn * PDGDaughters[iProng]));
+    }
+    return mixBits(mixBits((uint64_t)(int64_t)(sgn * PDGMother)) + sumDaughters);
+  }
+
+  /// Maximum number of daughters of a DecaySignature.
+  static constexpr std::size_t MaxDecaySignatureDaughters = 8;
+
+  /// Expected decay for bulk matching: hashes of the decay and of its charge conjugate,
+  /// and the daughter PDG codes to confirm a matching hash.
+  struct DecaySignature {
+    int PDGMother;
+    uint64_t hash;
+    uint64_t hashAnti;
+    int nDaughters;
+    array<int, MaxDecaySignatureDaughters> PDGDaughters;
+  };
+
+  /// Builds the signature of a decay, e.g. makeDecaySignature(kK0Short, array{+kPiPlus, -kPiPlus}).
+  /// \param PDGMother  expected mother PDG code
+  /// \param arrPDGDaughters  array of expected daughter PDG codes
+  template <std::size_t N>
+  static constexpr DecaySignature makeDecaySignature(int PDGMother, const array<int, N>& arrPDGDaughters)
+  {
+    static_assert(N <= MaxDecaySignatureDaughters, "too many daughters for a DecaySignature");
+    DecaySignature signature{PDGMother, decayHash(PDGMother, arrPDGDaughters.data(), N, 1), decayHash(PDGMother, arrPDGDaughters.data(), N, -1), (int)N, {}};
+    for (std::size_t iProng = 0; iProng < N; ++iProng) {
+      signature.PDGDaughters[iProng] = arrPDGDaughters[iProng];
+    }
+    return signature;
+  }
+
+  /// Flat index of an MC particle table, built once per dataframe in O(N).
+  class MCDecayIndex
+  {
+   public:
+    /// Indexes the table.
+    /// \param particlesMC  table with MC particles
+    template <typename T>
+    void build(const T& particlesMC)
+    {
+      const auto nParticles = particlesMC.size();
+      mPDG.resize(nParticles);
+      mMother.resize(nParticles);
+      mDaughterFirst.resize(nParticles);
+      mDaughterLast.resize(nParticles);
+      mHash.resize(nParticles);
+      int index = 0;
+      for (const auto& particle : particlesMC) {
+        mPDG[index] = particle.pdgCode();
+        mMother[index] = particle.mother0();
+        mDaughterFirst[index] = particle.daughter0();
+        mDaughterLast[index] = particle.daughter1();
+        ++index;
+      }
+      // decay hashes need the PDG codes of the daughters, hence the second pass
+      std::vector<int> PDGDaughters;
+      for (index = 0; index < (int)nParticles; ++index) {
+        PDGDaughters.clear();
+        if (hasDaughterRange(index)) {
+          for (auto iDaughter = mDaughterFirst[index]; iDaughter <= mDaughterLast[index]; ++iDaughter) {
+            PDGDaughters.push_back(mPDG[iDaughter]);
+          }
+        }
+        mHash[index] = decayHash(mPDG[index], PDGDaughters.data(), PDGDaughters.size());
+      }
+    }
+
+    int size() const { return mPDG.size(); }
+    int pdgCode(int index) const { return mPDG[index]; }
+    int mother(int index) const { return mMother[index]; }
+    std::pair<int, int> daughters(int index) const { return {mDaughterFirst[index], mDaughterLast[index]}; }
+    uint64_t decaySignature(int index) const { return mHash[index]; }
+
+    /// Same as RecoDecay::isMCMatchedDecayGen with daughters, for an indexed particle.
+    /// As there, a signature with fewer than two daughters only checks the PDG code of the particle.
+    /// \param index  index of the MC particle
+    /// \param signature  expected decay
+    /// \param acceptAntiParticles  switch to accept the antiparticle version of the expected decay
+    /// \return 1 for the particle, -1 for the antiparticle, 0 if not matched
+    int matchGen(int index, const DecaySignature& signature, bool acceptAntiParticles = false) const
+    {
+      const bool checkDaughters = signature.nDaughters > 1;
+      if (mPDG[index] == signature.PDGMother && (!checkDaughters || (mHash[index] == signature.hash && hasDaughterPDGs(index, signature, 1)))) {
+        return 1;
+      }
+      if (acceptAntiParticles && mPDG[index] == -signature.PDGMother && (!checkDaughters || (mHash[index] == signature.hashAnti && hasDaughterPDGs(index, signature, -1)))) {
+        return -1;
+      }
+      return 0;
+    }
+
+    /// Same as RecoDecay::isMCMatchedDecayRec for the MC particles matched to the candidate daughters.
+    /// Fewer than two daughters never match; isMCMatchedDecayRec rejects one daughter as well,
+    /// but accepts any (empty) candidate without daughters.
+    /// \param arrDaughtersIndex  indices of the MC particles of the candidate daughters
+    /// \param signature  expected decay
+    /// \param acceptAntiParticles  switch to accept the antiparticle version of the expected decay
+    /// \return 1 for the particle, -1 for the antiparticle, 0 if not matched
+    template <std::size_t N>
+    int matchRec(const array<int, N>& arrDaughtersIndex, const DecaySignature& signature, bool acceptAntiParticles = false) const
+    {
+      if constexpr (N < 2) {
+        return 0;
+      }
+      if ((int)N != signature.nDaughters) {
+        return 0;
+      }
+      for (std::size_t iProng = 0; iProng < N; ++iProng) {
+        if (arrDaughtersIndex[iProng] < 0) {
+          return 0;
+        }
+      }
+      auto indexMother = mMother[arrDaughtersIndex[0]];
+      if (indexMother < 0 || !hasDaughterRange(indexMother) || std::size_t(mDaughterLast[indexMother] - mDaughterFirst[indexMother] + 1) != N) {
+        return 0;
+      }
+      for (std::size_t iProng = 0; iProng < N; ++iProng) {
+        // same mother, no stepdaughters and no twins: the prongs are then exactly the N daughters of the mother
+        if (mMother[arrDaughtersIndex[iProng]] != indexMother || arrDaughtersIndex[iProng] < mDaughterFirst[indexMother] || arrDaughtersIndex[iProng] > mDaughterLast[indexMother]) {
+          return 0;
+        }
+        for (std::size_t jProng = 0; jProng < iProng; ++jProng) {
+          if (arrDaughtersIndex[iProng] == arrDaughtersIndex[jProng]) {
+            return 0;
+          }
+        }
+      }
+      return matchGen(indexMother, signature, acceptAntiParticles);
+    }
+
+    /// Matches the candidate daughters (tracks with MC labels).
+    /// \param arrDaughters  array of candidate daughters
+    template <std::size_t N, typename U>
+    int matchRec(const array<U, N>& arrDaughters, const DecaySignature& signature, bool acceptAntiParticles = false) const
+    {
+      array<int, N> arrDaughtersIndex;
+      for (std::size_t iProng = 0; iProng < N; ++iProng) {
+        arrDaughtersIndex[iProng] = arrDaughters[iProng].label().globalIndex();
+      }
+      return matchRec(arrDaughtersIndex, signature, acceptAntiParticles);
+    }
+
+    /// Matches many candidates at once.
+    /// \param daughtersIndex  per candidate, the indices of the MC particles of its daughters
+    /// \param out  per candidate, 1 for the particle, -1 for the antiparticle, 0 if not matched
+    template <std::size_t N>
+    void matchRec(const std::vector<array<int, N>>& daughtersIndex, const DecaySignature& signature, std::vector<int8_t>& out, bool acceptAntiParticles = false) const
+    {
+      out.resize(daughtersIndex.size());
+      for (std::size_t iCand = 0; iCand < daughtersIndex.size(); ++iCand) {
+        out[iCand] = matchRec(daughtersIndex[iCand], signature, acceptAntiParticles);
+      }
+    }
+
+   private:
+    bool hasDaughterRange(int index) const
+    {
+      return mDaughterFirst[index] >= 0 && mDaughterLast[index] >= mDaughterFirst[index] && mDaughterLast[index] < (int)mPDG.size();
+    }
+
+    /// Checks that the daughters of the particle have the PDG codes of the signature, in any order.
+    /// \param sgn  -1 to compare with the charge-conjugate decay
+    bool hasDaughterPDGs(int index, const DecaySignature& signature, int sgn) const
+    {
+      const int nDaughters = hasDaughterRange(index) ? mDaughterLast[index] - mDaughterFirst[index] + 1 : 0;
+      if (nDaughters != signature.nDaughters) {
+        return false;
+      }
+      array<bool, MaxDecaySignatureDaughters> used{};
+      for (auto iDaughter = mDaughterFirst[index]; iDaughter < mDaughterFirst[index] + nDaughters; ++iDaughter) {
+        int iProng = 0;
+        while (iProng < nDaughters && (used[iProng] || mPDG[iDaughter] != sgn * signature.PDGDaughters[iProng])) {
+          ++iProng;
+        }
+        if (iProng == nDaughters) {
+          return false;
+        }
+        used[iProng] = true;
+      }
+      return true;
+    }
+
+    std::vector<int> mPDG;           ///< PDG code
+    std::vector<int> mMother;        ///< index of the (first) mother, -1 if none
+    std::vector<int> mDaughterFirst; ///< index of the first daughter, -1 if none
+    std::vector<int> mDaughterLast;  ///< index of the last daughter, -1 if none
+    std::vector<uint64_t> mHash;     ///< decayHash of the particle and its daughters
+  };
+
  private:
-  static std::vector<std::tuple<int, double>> mListMass; ///< list of particle masses in form (PDG code, mass)
+  /// Masses (GeV/c^2) of the species used in the studies, sorted by PDG code, for the
+  /// compile-time getMassPDG<pdg>() and the TwoProngHypothesis constants only.
+  /// Light flavour from the PDG Review of Particle Physics (2022), (hyper)nuclei as defined
+  /// in configCustomParticleGun.cfg. These are not the TDatabasePDG values (e.g. K0S
+  /// 0.497611 here), which getMassPDG(pdg) keeps returning.
+  static constexpr std::array<std::pair<int, double>, 16> MassTable{{
+    {kElectron, 0.51099895e-3},            // e
+    {kGamma, 0.},                          // γ
+    {kPiPlus, 0.13957039},                 // π
+    {kK0Short, 0.497611},                  // K0S
+    {kKPlus, 0.493677},                    // K
+    {kProton, 0.93827208816},              // p
+    {kLambda0, 1.115683},                  // Λ
+    {kXiMinus, 1.32171},                   // Ξ
+    {kOmegaMinus, 1.67245},                // Ω
+    {1000010020, 1.89},                    // deuteron
+    {1000020030, 2.808391},                // 3He
+    {1000020040, 3.708391},                // 4He
+    {1010010030, 2.99131},                 // hypertriton
+    {1010010040, 3.9},                     // 4ΛH
+    {1010020040, 3.929},                   // 4ΛHe
+    {1020010040, 4.814}}};                 // 4ΛΛH
+
+  /// Fixed-size open-addressing cache (PDG code -> mass) of the TDatabasePDG masses.
+  /// Lookups never block. A writer claims an empty slot, fills it and publishes it;
+  /// a reader racing with a writer may miss and insert the same entry twice, which is harmless.
+  class MassCache
+  {
+   public:
+    bool find(int pdg, double& mass) const
+    {
+      for (std::size_t i = 0, slot = hash(pdg); i < Size; ++i, slot = (slot + 1) % Size) {
+        int state = mState[slot].load(std::memory_order_acquire);
+        if (state == Empty) {
+          return false;
+        }
+        if (state == Ready && mPDG[slot] == pdg) {
+          mass = mMass[slot];
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void insert(int pdg, double mass)
+    {
+      for (std::size_t i = 0, slot = hash(pdg); i < Size; ++i, slot = (slot + 1) % Size) {
+        int expected = Empty;
+        if (mState[slot].compare_exchange_strong(expected, Writing, std::memory_order_acq_rel)) {
+          mPDG[slot] = pdg;
+          mMass[slot] = mass;
+          mState[slot].store(Ready, std::memory_order_release);
+          return;
+        }
+      }
+      // cache full: the mass is still returned, just not cached
+    }
+
+   private:
+    static constexpr std::size_t Size = 256;
+    enum SlotState : int { Empty = 0,
+                           Writing,
+                           Ready };
+    static std::size_t hash(int pdg) { return (std::size_t)(pdg * 2654435761u) % Size; }
+
+    std::array<std::atomic<int>, Size> mState{};
+    std::array<int, Size> mPDG{};
+    std::array<double, Size> mMass{};
+  };
+
+  static MassCache mListMass; ///< cache of the TDatabasePDG particle masses
+  static std::mutex mMutexPDG; ///< serialises TDatabasePDG lookups
 };
 
-std::vector<std::tuple<int, double>> RecoDecay::mListMass;
+RecoDecay::MassCache RecoDecay::mListMass;
+std::mutex RecoDecay::mMutexPDG;
 
 #endif // O2_ANALYSIS_RECODECAY_H_
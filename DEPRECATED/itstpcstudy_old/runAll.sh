@@ -2,13 +2,23 @@
 
 #root.exe -q -b runMatcherStudy01.C+\(\"..\"\,\"test.root\"\,1\)
 
+# one process per batch, streaming over all its tf*/ directories (lIndex = 0)
+# append \,0\,1\,\"none\"\,404\,true to the arguments (source, threads, material correction, compression) to also run the TPC photon conversion finder
 for i in {000..011}
 do
-  for j in {1..5}
-  do
-    echo "Preparing command tf ${i}, file ${j}"
-    root.exe -q -b runMatcherStudy01.C+\(\"\/storage1\/daviddc\/k0gun\/${i}\/tf${j}\"\,\"output_slot${i}_tf${j}.root\"\,${j}\) &> log${i}_${j}.txt &
-    sleep 2
-  done
-  sleep 20 
-done
\ No newline at end of file
+  echo "Preparing command batch ${i}"
+  root.exe -q -b runMatcherStudy01.C+\(\"\/storage1\/daviddc\/k0gun\/${i}\"\,\"output_slot${i}.root\"\,0\) &> log${i}.txt &
+  sleep 2
+done
+
+# one process per timeframe (old behaviour)
+#for i in {000..011}
+#do
+#  for j in {1..5}
+#  do
+#    echo "Preparing command tf ${i}, file ${j}"
+#    root.exe -q -b runMatcherStudy01.C+\(\"\/storage1\/daviddc\/k0gun\/${i}\/tf${j}\"\,\"output_slot${i}_tf${j}.root\"\,${j}\) &> log${i}_${j}.txt &
+#    sleep 2
+#  done
+#  sleep 20 
+#done
@@ -0,0 +1,53 @@
+/// \file GunRandomEngine.h
+/// \brief Random engine of the particle guns, shared by GenProduction/generator_pythia8_gun.C
+/// and DEPRECATED/itstpcstudy_old/generator_pythia8_gun.C. Copy it next to the macro when
+/// the macro is copied elsewhere (see micro.sh and runbatch.sh).
+
+#ifndef GUNRANDOMENGINE_H_
+#define GUNRANDOMENGINE_H_
+
+#include "TRandom3.h"
+
+#include <iostream>
+
+//__________________________________________________________________
+/// Random engine of the gun, one per generator instance. Mersenne Twister
+/// (TRandom3) by default; optionally a counter-based SplitMix64 stream, which
+/// is stateless apart from (key, counter), so independent reproducible streams
+/// per thread or batch cost nothing to create. All TRandom samplers (Uniform,
+/// Poisson, Gaus, ...) go through Rndm() and thus through the selected engine.
+class GunRandomEngine : public TRandom3
+{
+public:
+  /// seed < 0: take the workflow seed (o2-sim --seed). o2-sim seeds gRandom with it;
+  /// TRandom::GetSeed() returns that seed, whereas TRandom3::GetSeed() returns the
+  /// current generator state, which changes with every draw made before this call.
+  /// stream: independent streams for the same seed, e.g. one per generator instance
+  void setSeed(Long64_t seed, bool counterBased = false, ULong64_t stream = 0){
+    if (seed < 0) seed = gRandom ? gRandom->TRandom::GetSeed() : 0;
+    mCounterBased = counterBased;
+    mKey = mix(ULong64_t(seed) ^ mix(stream + 1));
+    mCounter = 0;
+    TRandom3::SetSeed(UInt_t(mix(mKey)) | 1); // never 0, which would mean "seed from time"
+    std::cout << "Gun random engine: " << (counterBased ? "counter-based" : "TRandom3") << ", seed " << seed << ", stream " << stream << std::endl;
+  }
+
+  Double_t Rndm() override {
+    if (!mCounterBased) return TRandom3::Rndm();
+    // 53 random bits mapped to the open interval (0,1), like TRandom3
+    return ((mix(mKey + (++mCounter) * 0x9E3779B97F4A7C15ULL) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+private:
+  static ULong64_t mix(ULong64_t x){
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  bool mCounterBased = false;
+  ULong64_t mKey = 0;
+  ULong64_t mCounter = 0;
+};
+
+#endif // GUNRANDOMENGINE_H_
@@ -12,7 +12,9 @@ cp runSimulation.sh ${1}/.
 cp configs.sh ${1}/.
 cp configParticleGun.ini ${1}/.
 cp configCustomParticleGun.cfg ${1}/.
+cp configInjection.cfg ${1}/.
 cp generator_pythia8_gun.C ${1}/.
+cp GunRandomEngine.h ${1}/.
 cp ALICEStandard_Run3.cmnd ${1}/.
 cd ${1}
 